@@ -0,0 +1,183 @@
+#pragma once
+#include "XORPattern.hpp"
+#include <array>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PATTERNSCAN_PACKED_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace patterns {
+
+    namespace detail {
+        __forceinline uint32_t lowest_bit(uint32_t value) {
+#ifdef _MSC_VER
+            unsigned long idx;
+            _BitScanForward(&idx, value);
+            return idx;
+#else
+            return __builtin_ctz(value);
+#endif
+        }
+    }
+
+    // Compile time pattern keeping one mask bit per byte instead of a whole mask byte, so the pattern data
+    // takes narr + narr / 8 bytes instead of 2 * narr (3 * narr for XORPattern). With SSE2 the bits are ANDed
+    // directly with 16 byte compare masks.
+    // mask() has no byte mask to return (nullptr), use packed_mask() / wildcard() instead.
+    // Bytes are stored as is, so packing an XORPattern gives up its obfuscation.
+    template<size_t narr>
+    class PackedPattern : public Pattern {
+        std::array<uint8_t, narr> pattern_;
+        // Bit (j % 32) of word (j / 32) is set when byte j has to match
+        std::array<uint32_t, (narr + 31) / 32> bits_;
+
+        bool __forceinline bit(size_t idx) const {
+            return (bits_[idx / 32] >> (idx % 32)) & 1;
+        }
+        bool __forceinline compare_packed(const uint8_t* address) const {
+            size_t j = 0;
+#ifdef PATTERNSCAN_PACKED_SSE2
+            for (; j + 16 <= length_; j += 16) {
+                const auto data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern_.data() + j));
+                const auto mem = _mm_loadu_si128(reinterpret_cast<const __m128i*>(address + j));
+                const auto equal = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(data, mem)));
+                if (~equal & (bits_[j / 32] >> (j % 32)) & 0xFFFF)
+                    return false;
+            }
+#endif
+            for (; j < length_; ++j) {
+                if (bit(j) && pattern_[j] != address[j])
+                    return false;
+            }
+            return true;
+        }
+    public:
+        constexpr PackedPattern(const char* p, size_t nstr) :
+            pattern_{}, bits_{}
+        {
+            length_ = narr;
+            auto n = 0;
+            for (auto i = 0; i < nstr; i += 2) {
+                auto ptr = &p[i];
+                if (*ptr == '?') {
+                    ++n;
+                }
+                // Capture where we have our offset marker 'X' at
+                else if (*ptr == 'X' || *ptr == 'x') {
+                    offset_ = n;
+                    if (p[i + 1] != ' ') {
+                        insn_len_ = get_inst_len_opt(&p[++i]);
+                        while (p[i + 1] != ' ')
+                            ++i;
+                    }
+                }
+                // Break from parsing the pattern, since / at the end starts the flags
+                else if (*ptr == '/') {
+                    ++ptr;
+                    handle_options(ptr);
+                    break;
+                }
+                else if (*ptr != ' ') {
+                    pattern_[n] = value(ptr);
+                    bits_[n / 32] |= 1u << (n % 32);
+                    ++n;
+                }
+                else --i;
+            }
+        }
+        // Packs an already parsed pattern, keeping its offset and options
+        PackedPattern(const Pattern& other) :
+            Pattern(other), pattern_{}, bits_{}
+        {
+            if (length_ > narr)
+                throw std::logic_error("Pattern is longer than the packed storage!");
+            for (auto j = 0U; j < length_; ++j) {
+                if (other.wildcard(j))
+                    continue;
+                pattern_[j] = other[j];
+                bits_[j / 32] |= 1u << (j % 32);
+            }
+        }
+        ~PackedPattern() = default;
+        virtual const uint8_t* pattern() const override {
+            return pattern_.data();
+        }
+        virtual const uint8_t* mask() const override {
+            return nullptr;
+        }
+        const uint32_t* packed_mask() const {
+            return bits_.data();
+        }
+        virtual bool wildcard(size_t idx) const override {
+            return !bit(idx);
+        }
+        virtual bool match(const uint8_t* address) const override {
+            return compare_packed(address);
+        }
+        virtual void* find(const uint8_t* bytes, size_t size) const override {
+            void* result = nullptr;
+            const auto end = bytes + size - length_;
+            auto i = const_cast<uint8_t*>(bytes);
+#ifdef PATTERNSCAN_PACKED_SSE2
+            // Check 16 positions at a time against the first and last fixed bytes, only verifying where both hit
+            size_t first = 0, last = length_;
+            while (first < length_ && !bit(first))
+                ++first;
+            while (last > first && !bit(last - 1))
+                --last;
+            if (first < length_ && size >= length_) {
+                --last;
+                const auto first_byte = _mm_set1_epi8(static_cast<char>(pattern_[first]));
+                const auto last_byte = _mm_set1_epi8(static_cast<char>(pattern_[last]));
+                // Positions within a block the scan is allowed to start at
+                const uint32_t allowed = align_ ? (align_size_ == 4 ? 0x1111 : 0x0101) : 0xFFFF;
+                for (; i + 16 <= end; i += 16) {
+                    const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(i + first));
+                    const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(i + last));
+                    auto hits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, first_byte))
+                        & _mm_movemask_epi8(_mm_cmpeq_epi8(b, last_byte))) & allowed;
+                    while (hits) {
+                        const auto pos = i + detail::lowest_bit(hits);
+                        if (compare_packed(pos))
+                            return get_result(pos, end);
+                        hits &= hits - 1;
+                    }
+                }
+            }
+#endif
+            for (; i < end; align_ ? i += align_size_ : ++i) {
+                if (compare_packed(i))
+                    return get_result(i, end);
+            }
+            return result;
+        }
+        template <typename T>
+        T find(const uint8_t* bytes, size_t size) const {
+            return reinterpret_cast<T>(find(bytes, size));
+        }
+    };
+
+    template<size_t nstr, size_t narr>
+    PackedPattern<narr> pack(const CompileTimePattern<nstr, narr>& other) {
+        return PackedPattern<narr>(other);
+    }
+
+    template<size_t nstr, size_t narr, uint32_t hash>
+    PackedPattern<narr> pack(const XORPattern<nstr, narr, hash>& other) {
+        return PackedPattern<narr>(other);
+    }
+}
+
+#if __cplusplus > 201703L
+template<patterns::detail::const_string str>
+constexpr auto operator"" _pkpattern() {
+    return patterns::PackedPattern<patterns::detail::pattern_length(str.data, str.size)>(str.data, str.length);
+}
+#else
+#ifndef PACKED_PATTERN
+#define PACKED_PATTERN(x) patterns::PackedPattern<patterns::detail::pattern_length(x)>(x, sizeof(x)-1)
+#endif
+#endif
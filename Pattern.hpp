@@ -241,6 +241,12 @@ namespace patterns {
         const bool __forceinline aligned() const {
             return align_;
         }
+        // Step used between scan positions when aligned
+        static constexpr size_t __forceinline alignment() {
+            return align_size_;
+        }
+        // Byte mask, 0xFF where the byte has to match. May be nullptr for patterns without a byte mask (PackedPattern),
+        // which then override find, match and wildcard. Go through wildcard() to check a byte of any pattern
         virtual const uint8_t* mask() const = 0;
         virtual const uint8_t* pattern() const = 0;
         template <typename T>
@@ -249,51 +255,72 @@ namespace patterns {
         }
         virtual void* find(const uint8_t* bytes, size_t size) const {
             void* result = nullptr;
-            const auto pattern = const_cast<uint8_t*>(this->pattern());
-            const auto mask = const_cast<uint8_t*>(this->mask());
+            const auto pattern = this->pattern();
+            const auto mask = this->mask();
             const auto end = bytes + size - length_;
             for (auto i = const_cast<uint8_t*>(bytes); i < end; align_ ? i += align_size_ : ++i) {
-                bool found = true;
+                if (compare(pattern, mask, i))
+                    return get_result(i, end);
+            }
+            return result;
+        }
+        // Checks the pattern against a single position, address needs length() readable bytes
+        virtual bool match(const uint8_t* address) const {
+            return compare(pattern(), mask(), address);
+        }
+        // Returns true if the byte at idx is a ? in the pattern
+        virtual bool wildcard(size_t idx) const {
+            return mask()[idx] != 0xFF;
+        }
+        // Gets the result (offset, relative or dereferenced) of a match at address. end bounds the buffer it's in
+        void* resolve(const uint8_t* address, const uint8_t* end) const {
+            return get_result(const_cast<uint8_t*>(address), end);
+        }
+        // Same as above for a copy of the memory, where base is the address (or stream offset) the copy at address came from.
+        // Addresses relative to the match (including arm64 branch/adr/adrp) are computed from base, values read or
+        // decoded from the match (relative reads, arm64 ldr/str/movz/add immediates) are returned unchanged
+        uint64_t resolve(const uint8_t* address, const uint8_t* end, uint64_t base) const {
+            return get_result(const_cast<uint8_t*>(address), end, base);
+        }
+        virtual uint8_t operator[](size_t idx) const {
+            return pattern()[idx];
+        }
+    protected:
+        bool __forceinline compare(const uint8_t* pattern, const uint8_t* mask, const uint8_t* i) const {
+            bool found = true;
 #ifdef __arm64__
-                // Doing byte by byte match due to arm being encoded instructions, unless specified to align scan
-                if (align_) {
-                    for (auto j = 0U; j < length_; j += align_size_) {
-                        const auto data = *reinterpret_cast<uint32_t*>(pattern + j);
-                        const auto msk = *reinterpret_cast<uint32_t*>(mask + j);
-                        const auto mem = *reinterpret_cast<uint32_t*>(i + j);
-                        if ((data ^ mem) & msk) {
-                            found = false;
-                            break;
-                        }
-                    }
-                } else {
-                    for (auto j = 0U; j < length_; ++j) {
-                        if (mask[j] == 0xFF && pattern[j] != i[j]) {
-                            found = false;
-                            break;
-                        }
+            // Doing byte by byte match due to arm being encoded instructions, unless specified to align scan
+            if (align_) {
+                for (auto j = 0U; j < length_; j += align_size_) {
+                    const auto data = *reinterpret_cast<const uint32_t*>(pattern + j);
+                    const auto msk = *reinterpret_cast<const uint32_t*>(mask + j);
+                    const auto mem = *reinterpret_cast<const uint32_t*>(i + j);
+                    if ((data ^ mem) & msk) {
+                        found = false;
+                        break;
                     }
                 }
-#else
-                for (auto j = 0U; j < length_; j += sizeof(void*)) {
-                    const auto data = *reinterpret_cast<uintptr_t*>(pattern + j);
-                    const auto msk = *reinterpret_cast<uintptr_t*>(mask + j);
-                    const auto mem = *reinterpret_cast<uintptr_t*>(i + j);
-                    if ((data ^ mem) & msk) {
+            } else {
+                for (auto j = 0U; j < length_; ++j) {
+                    if (mask[j] == 0xFF && pattern[j] != i[j]) {
                         found = false;
                         break;
                     }
                 }
-#endif
-                if (found)
-                    return get_result(i, end);
             }
-            return result;
-        }
-        virtual uint8_t operator[](size_t idx) const {
-            return pattern()[idx];
+#else
+            for (auto j = 0U; j < length_; j += sizeof(void*)) {
+                const auto data = *reinterpret_cast<const uintptr_t*>(pattern + j);
+                const auto msk = *reinterpret_cast<const uintptr_t*>(mask + j);
+                const auto mem = *reinterpret_cast<const uintptr_t*>(i + j);
+                if ((data ^ mem) & msk) {
+                    found = false;
+                    break;
+                }
+            }
+#endif
+            return found;
         }
-    protected:
         // Credits to EJT for the helper functions here!
         constexpr __forceinline uint8_t value(const char* c) const {
             return (get_bits(c[0]) << 4 | get_bits(c[1]));
@@ -329,14 +356,20 @@ namespace patterns {
             }
         }
         void* get_result(uint8_t* address, const uint8_t* end) const {
+            return reinterpret_cast<void*>(static_cast<uintptr_t>(get_result(address, end, reinterpret_cast<uintptr_t>(address))));
+        }
+        // pc is the address the bytes at address really live at. Results pointing somewhere relative to the
+        // match are computed from it, values decoded or read from the match are returned as is
+        uint64_t get_result(uint8_t* address, const uint8_t* end, uint64_t pc) const {
 #ifdef __arm64__
             if (deref_) {
                 auto insn = reinterpret_cast<uint32_t*>(address + offset_);
+                const uint64_t insn_pc = pc + offset_;
                 int64_t offset = 0;
                 bool is_sub = false, is_adrp = false;
                 unsigned rd = 0, sf = 0, rn = 0;
                 if (detail::a64_decode_b(*insn, nullptr, &offset)) {
-                    return reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(insn) + offset);
+                    return insn_pc + offset;
                 }
                 else if (detail::a64_decode_adr(*insn, &is_adrp, &rd, &offset)) {
                     auto saved_offset = offset;
@@ -367,17 +400,17 @@ namespace patterns {
                             break;
                         }
                     }
-                    const auto from_addr = is_adrp ? reinterpret_cast<uintptr_t>(insn) & ~0xfff : reinterpret_cast<uintptr_t>(insn);
-                    return reinterpret_cast<void*>(from_addr + saved_offset);
+                    const auto from_addr = is_adrp ? insn_pc & ~static_cast<uint64_t>(0xfff) : insn_pc;
+                    return from_addr + saved_offset;
                 }
                 else if (detail::a64_decode_ldr(*insn, nullptr, nullptr, &offset) 
                         || detail::a64_decode_ldrh(*insn, nullptr, nullptr, &offset)
                         || detail::a64_decode_str(*insn, nullptr, nullptr, &offset)) {
-                    return reinterpret_cast<void*>(offset);
+                    return static_cast<uint64_t>(offset);
                 }
                 else if (detail::a64_decode_movz(*insn, &sf, nullptr, &offset)
                     || detail::a64_decode_arithmetic(*insn, nullptr, &sf, nullptr, nullptr, &offset)) {
-                    return reinterpret_cast<void*>((sf ? offset : static_cast<int32_t>(offset)));
+                    return static_cast<uint64_t>(sf ? offset : static_cast<int32_t>(offset));
                 }
                 else
                     throw std::logic_error("Failed to decode instruction with defined functions");
@@ -397,18 +430,17 @@ namespace patterns {
                     } else {
                         instrlen = offset_ + insn_len_;
                     }
-                    return reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(address)
-                        + instrlen + relative_address);
+                    return pc + instrlen + relative_address;
                 }
                 else {
-                    return reinterpret_cast<void*>(relative_address);
+                    return static_cast<uint64_t>(relative_address);
                 }
 #endif
             }
             else {
-                return reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(address) + offset_);
+                return pc + offset_;
             }
-            return nullptr;
+            return 0;
         }
 #ifndef __arm64__
         const intptr_t relative_value(uint8_t* ptr) const {
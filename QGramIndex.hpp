@@ -0,0 +1,259 @@
+#pragma once
+#include "Pattern.hpp"
+#include <vector>
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+namespace patterns {
+
+    namespace detail {
+        // Reads q (1 - 4) bytes as a little endian key
+        __forceinline uint32_t qgram_key(const uint8_t* p, uint32_t q) {
+            uint32_t key = 0;
+            for (auto i = 0U; i < q; ++i)
+                key |= static_cast<uint32_t>(p[i]) << (i * 8);
+            return key;
+        }
+
+        __forceinline uint32_t qgram_bucket(uint32_t key, uint32_t q, uint32_t bits) {
+            // Enough buckets to address every q-gram directly, no collisions to verify against
+            if (bits >= q * 8)
+                return key;
+            return (key * 2654435761u) >> (32 - bits);
+        }
+
+        inline uint32_t checksum(const uint8_t* bytes, size_t size) {
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < size; ++i)
+                hash = (hash ^ bytes[i]) * 16777619u;
+            return hash;
+        }
+    }
+
+    // Inverted index of q-gram positions over an immutable buffer. Built once, then any pattern can be
+    // looked up by the rarest run of fixed bytes it contains and only those candidates get verified.
+    class QGramIndex {
+    public:
+        struct Options {
+            // Bytes per gram (1 - 4). Longer grams are more selective but need longer fixed runs in the patterns
+            uint32_t q = 4;
+            // Only index every step'th position. Divides the position table by step, patterns then need
+            // q + step - 1 fixed bytes in a row to use the index
+            uint32_t step = 1;
+            // log2 of the bucket count (at most 28), capped at q * 8. Lower saves memory at the cost of more false candidates
+            uint32_t bucket_bits = 20;
+        };
+    private:
+        static constexpr uint32_t magic_ = 0x58494751; // QGIX
+        static constexpr uint32_t version_ = 1;
+        // 2^28 buckets is already a 1GB table
+        static constexpr uint32_t max_bucket_bits_ = 28;
+        const uint8_t* bytes_;
+        size_t size_;
+        Options options_;
+        // Bucket b's positions are positions_[starts_[b]] to positions_[starts_[b + 1]]
+        std::vector<uint32_t> starts_;
+        std::vector<uint32_t> positions_;
+
+        void validate() {
+            if (options_.q < 1 || options_.q > 4)
+                throw std::logic_error("Gram length must be between 1 and 4!");
+            if (options_.step < 1)
+                throw std::logic_error("Step must be at least 1!");
+            if (options_.bucket_bits < 1 || options_.bucket_bits > max_bucket_bits_)
+                throw std::logic_error("Bucket bits must be between 1 and 28!");
+            options_.bucket_bits = std::min(options_.bucket_bits, options_.q * 8);
+            if (size_ > UINT32_MAX)
+                throw std::logic_error("Buffer is too large to index!");
+        }
+        void build() {
+            const auto q = options_.q, bits = options_.bucket_bits;
+            starts_.assign((static_cast<size_t>(1) << bits) + 1, 0);
+            if (size_ < q)
+                return;
+            const auto last = size_ - q;
+            for (size_t i = 0; i <= last; i += options_.step)
+                ++starts_[detail::qgram_bucket(detail::qgram_key(bytes_ + i, q), q, bits) + 1];
+            for (size_t b = 1; b < starts_.size(); ++b)
+                starts_[b] += starts_[b - 1];
+            positions_.resize(starts_.back());
+            // Filling in order keeps every bucket sorted by position
+            std::vector<uint32_t> next(starts_.begin(), starts_.end() - 1);
+            for (size_t i = 0; i <= last; i += options_.step)
+                positions_[next[detail::qgram_bucket(detail::qgram_key(bytes_ + i, q), q, bits)]++] = static_cast<uint32_t>(i);
+        }
+        template <typename T>
+        static void write(std::ostream& os, const T& value) {
+            os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+        template <typename T>
+        static T read(std::istream& is) {
+            T value{};
+            if (!is.read(reinterpret_cast<char*>(&value), sizeof(T)))
+                throw std::runtime_error("Unexpected end of index data!");
+            return value;
+        }
+        // Calls fn(position, ordered) with every position the pattern matches at. ordered is true when the positions
+        // come in address order (linear fallback, or a single gram per anchor). Returns false from fn to stop
+        template <typename Fn>
+        void candidates(const Pattern& pattern, Fn&& fn) const {
+            const size_t length = pattern.length();
+            if (size_ <= length)
+                return;
+            // Same bounds as Pattern::find
+            const auto limit = size_ - length;
+            const auto step = pattern.aligned() ? pattern.alignment() : 1;
+            const auto q = options_.q, bits = options_.bucket_bits;
+            const size_t span = q + options_.step - 1;
+            std::vector<uint8_t> bytes(length);
+            for (size_t j = 0; j < length; ++j)
+                bytes[j] = pattern[j];
+            // Pick the anchor whose grams have the fewest positions between them
+            size_t anchor = 0, best = SIZE_MAX, run = 0;
+            for (size_t j = 0; j < length; ++j) {
+                run = pattern.wildcard(j) ? 0 : run + 1;
+                if (run < span)
+                    continue;
+                const auto o = j + 1 - span;
+                size_t cost = 0;
+                for (size_t k = 0; k < options_.step; ++k) {
+                    const auto b = detail::qgram_bucket(detail::qgram_key(&bytes[o + k], q), q, bits);
+                    cost += starts_[b + 1] - starts_[b];
+                }
+                if (cost < best) {
+                    best = cost;
+                    anchor = o;
+                }
+            }
+            // Not enough fixed bytes in a row to use the index, check every position instead
+            if (best == SIZE_MAX) {
+                for (size_t i = 0; i < limit; i += step) {
+                    if (pattern.match(bytes_ + i) && !fn(i, true))
+                        return;
+                }
+                return;
+            }
+            for (size_t k = 0; k < options_.step; ++k) {
+                const auto o = anchor + k;
+                const auto b = detail::qgram_bucket(detail::qgram_key(&bytes[o], q), q, bits);
+                for (auto p = starts_[b]; p < starts_[b + 1]; ++p) {
+                    const size_t pos = positions_[p];
+                    if (pos < o)
+                        continue;
+                    const auto i = pos - o;
+                    if (i >= limit)
+                        break;
+                    if (i % step == 0 && pattern.match(bytes_ + i) && !fn(i, options_.step == 1))
+                        return;
+                }
+            }
+        }
+    public:
+        QGramIndex(const uint8_t* bytes, size_t size, Options options) :
+            bytes_(bytes), size_(size), options_(options)
+        {
+            validate();
+            build();
+        }
+        QGramIndex(const uint8_t* bytes, size_t size) :
+            QGramIndex(bytes, size, Options())
+        {
+        }
+        // Loads an index previously written with save for the same buffer contents
+        QGramIndex(std::istream& is, const uint8_t* bytes, size_t size) :
+            bytes_(bytes), size_(size)
+        {
+            if (read<uint32_t>(is) != magic_ || read<uint32_t>(is) != version_)
+                throw std::runtime_error("Not a supported index!");
+            options_.q = read<uint32_t>(is);
+            options_.step = read<uint32_t>(is);
+            options_.bucket_bits = read<uint32_t>(is);
+            try {
+                validate();
+            } catch (const std::logic_error&) {
+                throw std::runtime_error("Index header is corrupt!");
+            }
+            if (read<uint64_t>(is) != size_ || read<uint32_t>(is) != detail::checksum(bytes_, size_))
+                throw std::runtime_error("Index was built from a different buffer!");
+            // Check the table sizes before allocating anything based on them
+            const auto buckets = read<uint64_t>(is);
+            const auto positions = read<uint64_t>(is);
+            if (buckets != (static_cast<uint64_t>(1) << options_.bucket_bits) + 1)
+                throw std::runtime_error("Index bucket table is corrupt!");
+            if (positions > size_ / options_.step + 1)
+                throw std::runtime_error("Index position table is corrupt!");
+            starts_.resize(static_cast<size_t>(buckets));
+            positions_.resize(static_cast<size_t>(positions));
+            if (!is.read(reinterpret_cast<char*>(starts_.data()), starts_.size() * sizeof(uint32_t))
+                || !is.read(reinterpret_cast<char*>(positions_.data()), positions_.size() * sizeof(uint32_t)))
+                throw std::runtime_error("Unexpected end of index data!");
+            // Every bucket has to stay within the position table
+            if (starts_.front() != 0 || starts_.back() != positions_.size())
+                throw std::runtime_error("Index bucket table is corrupt!");
+            for (size_t b = 1; b < starts_.size(); ++b) {
+                if (starts_[b] < starts_[b - 1])
+                    throw std::runtime_error("Index bucket table is corrupt!");
+            }
+            for (auto pos : positions_) {
+                if (static_cast<size_t>(pos) + options_.q > size_)
+                    throw std::runtime_error("Index position table is corrupt!");
+            }
+        }
+        ~QGramIndex() = default;
+        // Written in the native byte order, along with a checksum of the buffer to check against when loading
+        void save(std::ostream& os) const {
+            write(os, magic_);
+            write(os, version_);
+            write(os, options_.q);
+            write(os, options_.step);
+            write(os, options_.bucket_bits);
+            write(os, static_cast<uint64_t>(size_));
+            write(os, detail::checksum(bytes_, size_));
+            write(os, static_cast<uint64_t>(starts_.size()));
+            write(os, static_cast<uint64_t>(positions_.size()));
+            os.write(reinterpret_cast<const char*>(starts_.data()), starts_.size() * sizeof(uint32_t));
+            os.write(reinterpret_cast<const char*>(positions_.data()), positions_.size() * sizeof(uint32_t));
+            if (!os)
+                throw std::runtime_error("Failed to write index!");
+        }
+        const Options& options() const {
+            return options_;
+        }
+        // Bytes used by the index itself (not counting the buffer)
+        size_t memory_usage() const {
+            return (starts_.size() + positions_.size()) * sizeof(uint32_t);
+        }
+        // Same result as pattern.find over the whole buffer
+        void* find(const Pattern& pattern) const {
+            size_t first = SIZE_MAX;
+            candidates(pattern, [&](size_t i, bool ordered) {
+                first = std::min(first, i);
+                // In address order the first match is the lowest, otherwise every candidate has to be seen
+                return !ordered;
+            });
+            if (first == SIZE_MAX)
+                return nullptr;
+            return pattern.resolve(bytes_ + first, bytes_ + size_ - pattern.length());
+        }
+        template <typename T>
+        T find(const Pattern& pattern) const {
+            return reinterpret_cast<T>(find(pattern));
+        }
+        // Every match in the buffer, in address order
+        std::vector<void*> find_all(const Pattern& pattern) const {
+            std::vector<size_t> matches;
+            candidates(pattern, [&](size_t i, bool) {
+                matches.push_back(i);
+                return true;
+            });
+            std::sort(matches.begin(), matches.end());
+            std::vector<void*> results;
+            results.reserve(matches.size());
+            for (auto i : matches)
+                results.push_back(pattern.resolve(bytes_ + i, bytes_ + size_ - pattern.length()));
+            return results;
+        }
+    };
+}
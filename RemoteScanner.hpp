@@ -0,0 +1,331 @@
+#pragma once
+#include "Pattern.hpp"
+#ifdef __linux__
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <climits>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+#include <stdexcept>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+namespace patterns {
+
+    struct RemoteRegion {
+        uintptr_t start;
+        uintptr_t end;
+        bool readable;
+        bool writable;
+        bool executable;
+        std::string path;
+    };
+
+    // Scans the memory of another process using process_vm_readv. Regions come from /proc/pid/maps and are read in
+    // batches (many regions per syscall) into two buffers, so the next batch is being read while the current one is scanned.
+    // Results are addresses in the remote process.
+    class RemoteScanner {
+        // Part of a region read into a batch. Matches are only started in the first scan bytes,
+        // the rest (up to length - 1 bytes) overlaps with the next piece
+        struct Piece {
+            uintptr_t address;
+            size_t size;
+            size_t scan;
+            size_t offset;
+            size_t read;
+        };
+        struct Batch {
+            std::vector<uint8_t> buffer;
+            std::vector<Piece> pieces;
+        };
+        // Where the next batch starts from
+        struct Cursor {
+            size_t region = 0;
+            uintptr_t address = 0;
+        };
+        // Reads batches on its own thread into two buffers, handing each over to the scan once it's read
+        // and reusing it once the scan releases it
+        class BatchReader {
+            const RemoteScanner& scanner_;
+            size_t length_;
+            const std::string& module_;
+            Cursor cursor_;
+            Batch batches_[2];
+            bool ready_[2]{};
+            bool finished_ = false;
+            bool stop_ = false;
+            std::exception_ptr error_;
+            std::mutex mutex_;
+            std::condition_variable cv_;
+            std::thread thread_;
+
+            void run() {
+                try {
+                    for (auto current = 0;; current ^= 1) {
+                        {
+                            std::unique_lock<std::mutex> lock(mutex_);
+                            cv_.wait(lock, [&]() { return !ready_[current] || stop_; });
+                            if (stop_)
+                                return;
+                        }
+                        const auto more = scanner_.plan(cursor_, batches_[current], length_, module_);
+                        if (more)
+                            scanner_.read_batch(batches_[current]);
+                        {
+                            std::lock_guard<std::mutex> lock(mutex_);
+                            if (more)
+                                ready_[current] = true;
+                            else
+                                finished_ = true;
+                        }
+                        cv_.notify_all();
+                        if (!more)
+                            return;
+                    }
+                } catch (...) {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        error_ = std::current_exception();
+                        finished_ = true;
+                    }
+                    cv_.notify_all();
+                }
+            }
+        public:
+            BatchReader(const RemoteScanner& scanner, size_t length, const std::string& module) :
+                scanner_(scanner), length_(length), module_(module), thread_(&BatchReader::run, this)
+            {
+            }
+            ~BatchReader() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stop_ = true;
+                }
+                cv_.notify_all();
+                thread_.join();
+            }
+            // Waits on batch current (alternating 0 and 1) to be read, nullptr once there's nothing left
+            const Batch* next(int current) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&]() { return ready_[current] || finished_; });
+                if (ready_[current])
+                    return &batches_[current];
+                if (error_)
+                    std::rethrow_exception(error_);
+                return nullptr;
+            }
+            // Hands the batch back to be read into again
+            void release(int current) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    ready_[current] = false;
+                }
+                cv_.notify_all();
+            }
+        };
+        pid_t pid_;
+        size_t chunk_size_;
+        std::vector<RemoteRegion> regions_;
+
+        static bool module_match(const RemoteRegion& region, const std::string& module) {
+            if (module.empty())
+                return true;
+            const auto& path = region.path;
+            return path == module || (path.size() > module.size() && path.compare(path.size() - module.size(), module.size(), module) == 0
+                && path[path.size() - module.size() - 1] == '/');
+        }
+        // EFAULT/EIO only mean part of the memory isn't readable (anymore). Anything else (EPERM without ptrace access,
+        // ESRCH once the process exits...) fails every read, so throw rather than look like nothing was found
+        static void check_read(ssize_t count) {
+            if (count < 0 && errno != EFAULT && errno != EIO)
+                throw std::runtime_error(std::string("Failed to read process memory: ") + strerror(errno));
+        }
+        // Fills batch with pieces from the cursor onwards until chunk_size_ bytes or IOV_MAX pieces. Returns false when done
+        bool plan(Cursor& cursor, Batch& batch, size_t length, const std::string& module) const {
+            batch.pieces.clear();
+            size_t used = 0;
+            for (; cursor.region < regions_.size() && used < chunk_size_ && batch.pieces.size() < IOV_MAX; ++cursor.region) {
+                const auto& region = regions_[cursor.region];
+                if (!region.readable || !module_match(region, module) || region.end - region.start < length)
+                    continue;
+                if (cursor.address < region.start)
+                    cursor.address = region.start;
+                const auto last = region.end - length + 1;
+                while (cursor.address < last && used < chunk_size_ && batch.pieces.size() < IOV_MAX) {
+                    const auto scan = std::min<size_t>(last - cursor.address, chunk_size_ - used);
+                    const auto size = scan + length - 1;
+                    batch.pieces.push_back(Piece{ cursor.address, size, scan, used, 0 });
+                    used += size;
+                    cursor.address += scan;
+                }
+                if (cursor.address < last)
+                    break;
+            }
+            if (batch.buffer.size() < used)
+                batch.buffer.resize(used);
+            return !batch.pieces.empty();
+        }
+        // Reads every piece, stopping a piece where the remote memory is no longer readable
+        void read_batch(Batch& batch) const {
+            std::vector<iovec> remote(batch.pieces.size());
+            for (size_t i = 0; i < batch.pieces.size(); ++i)
+                remote[i] = iovec{ reinterpret_cast<void*>(batch.pieces[i].address), batch.pieces[i].size };
+            size_t idx = 0;
+            while (idx < batch.pieces.size()) {
+                const auto& first = batch.pieces[idx];
+                iovec local{ batch.buffer.data() + first.offset, batch.buffer.size() - first.offset };
+                auto count = process_vm_readv(pid_, &local, 1, &remote[idx], remote.size() - idx, 0);
+                check_read(count);
+                // Nothing read from the first piece, skip over it
+                if (count <= 0) {
+                    batch.pieces[idx++].read = 0;
+                    continue;
+                }
+                auto left = static_cast<size_t>(count);
+                while (idx < batch.pieces.size() && left) {
+                    auto& piece = batch.pieces[idx++];
+                    piece.read = std::min(piece.size, left);
+                    left -= piece.read;
+                    // The read stopped partway through this piece, carry on from the next one
+                    if (piece.read < piece.size)
+                        break;
+                }
+            }
+        }
+    public:
+        RemoteScanner(pid_t pid, size_t chunk_size = 1 << 20) :
+            pid_(pid), chunk_size_(chunk_size)
+        {
+            if (!chunk_size_)
+                throw std::logic_error("Chunk size must be non zero!");
+            refresh();
+        }
+        ~RemoteScanner() = default;
+        pid_t pid() const {
+            return pid_;
+        }
+        const std::vector<RemoteRegion>& regions() const {
+            return regions_;
+        }
+        // Re-reads the memory map of the process
+        void refresh() {
+            std::ifstream maps("/proc/" + std::to_string(pid_) + "/maps");
+            if (!maps)
+                throw std::runtime_error("Failed to open the process memory map!");
+            regions_.clear();
+            std::string line;
+            while (std::getline(maps, line)) {
+                unsigned long start = 0, end = 0;
+                char perms[5]{};
+                int path = 0;
+                if (sscanf(line.c_str(), "%lx-%lx %4s %*s %*s %*s %n", &start, &end, perms, &path) < 3)
+                    continue;
+                regions_.push_back(RemoteRegion{ start, end, perms[0] == 'r', perms[1] == 'w', perms[2] == 'x',
+                    path ? line.substr(path) : std::string() });
+            }
+        }
+        // Reads from the process, returns how many bytes could be read
+        size_t read(uintptr_t address, void* buffer, size_t size) const {
+            iovec local{ buffer, size };
+            iovec remote{ reinterpret_cast<void*>(address), size };
+            const auto count = process_vm_readv(pid_, &local, 1, &remote, 1, 0);
+            check_read(count);
+            return count < 0 ? 0 : static_cast<size_t>(count);
+        }
+        template <typename T>
+        T read(uintptr_t address) const {
+            T value{};
+            if (read(address, &value, sizeof(T)) != sizeof(T))
+                throw std::runtime_error("Failed to read process memory!");
+            return value;
+        }
+        // Gets the result of a match at address, reading what's needed for relative/dereference from the process.
+        // Returns false if the match can no longer be read (or no longer matches)
+        bool resolve(const Pattern& pattern, uintptr_t address, uintptr_t& result) const {
+#ifdef __arm64__
+            if (!pattern.deref()) {
+#else
+            if (!pattern.deref() && !pattern.relative()) {
+#endif
+                result = address + pattern.offset();
+                return true;
+            }
+            // Room for the length disassembler (or arm64 decoding) to read past the pattern
+            std::vector<uint8_t> bytes(pattern.length() + 64);
+            const auto count = read(address, bytes.data(), bytes.size());
+            if (count < pattern.length() || !pattern.match(bytes.data()))
+                return false;
+            result = static_cast<uintptr_t>(pattern.resolve(bytes.data(), bytes.data() + count, address));
+            return true;
+        }
+        uintptr_t resolve(const Pattern& pattern, uintptr_t address) const {
+            uintptr_t result = 0;
+            if (!resolve(pattern, address, result))
+                throw std::runtime_error("Failed to read process memory!");
+            return result;
+        }
+        // Calls fn(address, result) for each match in the readable regions (of module when given) in address order.
+        // Matches that can't be read again to resolve (unmapped or changed since) are skipped. Return false from fn to stop
+        template <typename Fn>
+        void scan(const Pattern& pattern, Fn&& fn, const std::string& module = {}) const {
+            const size_t length = pattern.length();
+            if (!length)
+                return;
+            const auto step = pattern.aligned() ? pattern.alignment() : 1;
+            // The next batch is read while this one is scanned
+            BatchReader reader(*this, length, module);
+            for (auto current = 0;; current ^= 1) {
+                const auto batch = reader.next(current);
+                if (!batch)
+                    return;
+                for (const auto& piece : batch->pieces) {
+                    if (piece.read < length)
+                        continue;
+                    const auto bytes = batch->buffer.data() + piece.offset;
+                    const auto count = std::min(piece.scan, piece.read - length + 1);
+                    for (size_t i = (step - piece.address % step) % step; i < count; i += step) {
+                        uintptr_t result = 0;
+                        if (!pattern.match(bytes + i) || !resolve(pattern, piece.address + i, result))
+                            continue;
+                        if (!fn(piece.address + i, result))
+                            return;
+                    }
+                }
+                reader.release(current);
+            }
+        }
+        // First match, or 0 when not found
+        uintptr_t find(const Pattern& pattern, const std::string& module = {}) const {
+            uintptr_t result = 0;
+            scan(pattern, [&](uintptr_t, uintptr_t value) {
+                result = value;
+                return false;
+            }, module);
+            return result;
+        }
+        template <typename T>
+        T find(const Pattern& pattern, const std::string& module = {}) const {
+            return reinterpret_cast<T>(find(pattern, module));
+        }
+        std::vector<uintptr_t> find_all(const Pattern& pattern, const std::string& module = {}) const {
+            std::vector<uintptr_t> results;
+            scan(pattern, [&](uintptr_t, uintptr_t value) {
+                results.push_back(value);
+                return true;
+            }, module);
+            return results;
+        }
+    };
+}
+#endif
@@ -1,6 +1,7 @@
 #pragma once
 #include "Pattern.hpp"
 #include <vector>
+#include <cstring>
 #include <stdexcept>
 
 namespace patterns {
@@ -0,0 +1,200 @@
+#pragma once
+#include "Pattern.hpp"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <vector>
+#include <queue>
+
+namespace patterns {
+
+    // Handle to a pattern that is only scanned for the first time its result is asked for.
+    // Once resolved the result is read back with a single acquire load, no locking.
+    class Signature {
+        enum : uint8_t {
+            unresolved,
+            resolving,
+            resolved
+        };
+        const Pattern& pattern_;
+        const uint8_t* bytes_;
+        size_t size_;
+        int32_t priority_;
+        std::atomic<uint8_t> state_{ unresolved };
+        void* result_ = nullptr;
+        // Only used by threads waiting on another thread's scan
+        std::mutex mutex_;
+        std::condition_variable cv_;
+
+        void set_state(uint8_t state) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                state_.store(state, std::memory_order_release);
+            }
+            cv_.notify_all();
+        }
+    public:
+        Signature(const Pattern& pattern, const uint8_t* bytes, size_t size, int32_t priority = 0) :
+            pattern_(pattern), bytes_(bytes), size_(size), priority_(priority)
+        {
+        }
+        Signature(const Signature&) = delete;
+        Signature& operator=(const Signature&) = delete;
+        ~Signature() = default;
+        const Pattern& pattern() const {
+            return pattern_;
+        }
+        int32_t priority() const {
+            return priority_;
+        }
+        bool ready() const {
+            return state_.load(std::memory_order_acquire) == resolved;
+        }
+        void* get() {
+            if (state_.load(std::memory_order_acquire) == resolved)
+                return result_;
+            return resolve();
+        }
+        template <typename T>
+        T get() {
+            return reinterpret_cast<T>(get());
+        }
+        void* operator*() {
+            return get();
+        }
+        // Scans for the pattern if nobody has yet. Only one thread performs the scan, any others
+        // calling in at the same time block until it's finished
+        void* resolve() {
+            auto expected = static_cast<uint8_t>(unresolved);
+            if (state_.compare_exchange_strong(expected, resolving, std::memory_order_acquire)) {
+                try {
+                    result_ = pattern_.find(bytes_, size_);
+                } catch (...) {
+                    // Let the next caller try again (and see the exception itself)
+                    set_state(unresolved);
+                    throw;
+                }
+                set_state(resolved);
+                return result_;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [&]() { return state_.load(std::memory_order_acquire) != resolving; });
+            if (state_.load(std::memory_order_acquire) == resolved)
+                return result_;
+            // The resolving thread threw, so take over the scan
+            lock.unlock();
+            return resolve();
+        }
+    };
+
+    // Owns a set of signatures and optionally resolves them on a background thread (highest priority first)
+    // so that by the time they are first used the result is usually already there
+    class SignatureRegistry {
+        struct Pending {
+            int32_t priority;
+            // Registration order, to keep equal priorities first come first served
+            size_t order;
+            Signature* signature;
+            bool operator<(const Pending& other) const {
+                return priority != other.priority ? priority < other.priority : order > other.order;
+            }
+        };
+        std::vector<std::unique_ptr<Signature>> signatures_;
+        // Signatures before this index have already been handed to the worker
+        size_t queued_ = 0;
+        std::priority_queue<Pending> pending_;
+        mutable std::mutex mutex_;
+        std::condition_variable idle_;
+        std::thread worker_;
+        bool running_ = false;
+        bool stop_ = false;
+
+        void run() {
+            for (;;) {
+                Signature* sig = nullptr;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (stop_ || pending_.empty()) {
+                        running_ = false;
+                        idle_.notify_all();
+                        return;
+                    }
+                    sig = pending_.top().signature;
+                    pending_.pop();
+                }
+                if (sig->ready())
+                    continue;
+                try {
+                    sig->resolve();
+                } catch (...) {
+                    // Left unresolved, the first access will rethrow it
+                }
+            }
+        }
+        // The worker never takes the lock again once it has cleared running_, so it's safe to join under it
+        void join(std::unique_lock<std::mutex>& lock) {
+            idle_.wait(lock, [&]() { return !running_; });
+            if (worker_.joinable())
+                worker_.join();
+        }
+    public:
+        SignatureRegistry() = default;
+        SignatureRegistry(const SignatureRegistry&) = delete;
+        SignatureRegistry& operator=(const SignatureRegistry&) = delete;
+        ~SignatureRegistry() {
+            stop();
+        }
+        // Pattern must outlive the registry (intended for the global Compile/XOR patterns)
+        Signature& add(const Pattern& pattern, const uint8_t* bytes, size_t size, int32_t priority = 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            signatures_.push_back(std::make_unique<Signature>(pattern, bytes, size, priority));
+            return *signatures_.back();
+        }
+        size_t size() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return signatures_.size();
+        }
+        // Queues everything added since the last call to be resolved in the background. Never blocks the caller
+        // on a scan; can be called again after adding more signatures
+        void warm_up() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            for (; queued_ < signatures_.size(); ++queued_) {
+                const auto sig = signatures_[queued_].get();
+                pending_.push(Pending{ sig->priority(), queued_, sig });
+            }
+            // A running worker picks the new ones up before it goes idle
+            if (running_ || pending_.empty())
+                return;
+            join(lock);
+            stop_ = false;
+            running_ = true;
+            worker_ = std::thread(&SignatureRegistry::run, this);
+        }
+        // Resolves everything on the calling thread
+        void resolve_all() {
+            std::vector<Signature*> all;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                all.reserve(signatures_.size());
+                for (auto& sig : signatures_)
+                    all.push_back(sig.get());
+            }
+            for (auto sig : all)
+                sig->get();
+        }
+        // Waits on the background thread, abandoning any signatures it had not gotten to yet.
+        // They are picked up again by the next warm_up
+        void stop() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stop_ = true;
+            join(lock);
+        }
+        // Waits on the background thread to finish resolving everything it was given
+        void wait() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            join(lock);
+        }
+    };
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include "Pattern.hpp"
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+namespace patterns {
+
+    // Scans a stream of memory fed in arbitrary sized chunks without needing it in one buffer.
+    // Only the last length() - 1 bytes are kept between chunks so matches crossing a boundary are still found.
+    class StreamMatcher {
+    public:
+        struct Match {
+            // Stream offset of the start of the match
+            uint64_t offset;
+            // Stream offset the pattern resolved to, or the value itself for relative reads and arm64 immediates
+            uint64_t result;
+        };
+    private:
+        const Pattern& pattern_;
+        // Tail of everything fed so far that could still be the start of a match
+        std::vector<uint8_t> tail_;
+        // Tail plus the front of the next chunk, for matches straddling the two
+        std::vector<uint8_t> window_;
+        uint64_t position_;
+        int first_ = -1;
+
+        template <typename Fn>
+        size_t scan(const uint8_t* bytes, size_t count, const uint8_t* end, uint64_t base, Fn& on_match) const {
+            size_t found = 0;
+            const auto step = pattern_.aligned() ? pattern_.alignment() : 1;
+            for (size_t i = 0; i < count;) {
+                // Skip straight to the next occurrence of the first byte when there is one to look for
+                if (first_ >= 0) {
+                    const auto next = static_cast<const uint8_t*>(memchr(bytes + i, first_, count - i));
+                    if (!next)
+                        break;
+                    i = next - bytes;
+                }
+                else if ((base + i) % step) {
+                    i += step - (base + i) % step;
+                    continue;
+                }
+                if (pattern_.match(bytes + i)) {
+                    on_match(Match{ base + i, pattern_.resolve(bytes + i, end, base + i) });
+                    ++found;
+                }
+                i += step;
+            }
+            return found;
+        }
+    public:
+        // origin is the offset given to the first byte of the stream (i.e. the address the data came from)
+        StreamMatcher(const Pattern& pattern, uint64_t origin = 0) :
+            pattern_(pattern), position_(origin)
+        {
+            tail_.reserve(pattern_.length());
+            window_.reserve(pattern_.length() * 2);
+            if (!pattern_.aligned() && pattern_.length() && !pattern_.wildcard(0))
+                first_ = pattern_[0];
+        }
+        ~StreamMatcher() = default;
+        // Stream offset of the next byte to be fed
+        uint64_t position() const {
+            return position_;
+        }
+        // Drops any partial match and starts a new stream
+        void reset(uint64_t origin = 0) {
+            tail_.clear();
+            position_ = origin;
+        }
+        // Scans the next chunk of the stream, on_match is called with each Match in order. Returns the number found
+        template <typename Fn>
+        size_t feed(const uint8_t* chunk, size_t size, Fn&& on_match) {
+            const size_t length = pattern_.length();
+            if (!length)
+                return 0;
+            size_t found = 0;
+            if (!tail_.empty()) {
+                // Positions starting in the tail, wherever the whole pattern is available now
+                window_.assign(tail_.begin(), tail_.end());
+                window_.insert(window_.end(), chunk, chunk + std::min(size, length - 1));
+                if (window_.size() >= length) {
+                    const auto count = std::min(tail_.size(), window_.size() - length + 1);
+                    found += scan(window_.data(), count, window_.data() + window_.size(), position_ - tail_.size(), on_match);
+                }
+            }
+            if (size >= length)
+                found += scan(chunk, size - length + 1, chunk + size, position_, on_match);
+            // Keep whatever positions have not been checked yet
+            if (size >= length - 1) {
+                tail_.assign(chunk + size - (length - 1), chunk + size);
+            }
+            else {
+                tail_.insert(tail_.end(), chunk, chunk + size);
+                if (tail_.size() > length - 1)
+                    tail_.erase(tail_.begin(), tail_.end() - (length - 1));
+            }
+            position_ += size;
+            return found;
+        }
+        std::vector<Match> feed(const uint8_t* chunk, size_t size) {
+            std::vector<Match> matches;
+            feed(chunk, size, [&](const Match& match) {
+                matches.push_back(match);
+            });
+            return matches;
+        }
+    };
+}
@@ -95,6 +95,13 @@ namespace patterns {
             }
             return result;
         }
+        virtual bool match(const uint8_t* address) const override {
+            for (auto j = 0U; j < length_; ++j) {
+                if (mask_[j] == 0xFF && (*this)[j] != address[j])
+                    return false;
+            }
+            return true;
+        }
         template <typename T>
         T find(const uint8_t* bytes, size_t size) const {
             return reinterpret_cast<T>(find(bytes, size));